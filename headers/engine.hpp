@@ -2,6 +2,8 @@
 #define ENGINE
 #include <memory>
 #include "renderer.hpp"
+#include "game.hpp"
+#include "frame_pacer.hpp"
 
 
 /*struct DestroyglfwWin{
@@ -21,8 +23,11 @@ class Engine
 public:
     Engine();
 private:
-    Renderer* renderer;
-    GLFWwindow* window;
+    std::unique_ptr<Renderer> renderer;
+    std::unique_ptr<game::Game> game;
+    FramePacer pacer;
+    double cappedFrameTime = 1.0 / 60.0;
+    GLFWwindow* window = nullptr;
 };
 }
 #endif
\ No newline at end of file
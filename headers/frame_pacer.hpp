@@ -0,0 +1,87 @@
+#ifndef FRAME_PACER
+#define FRAME_PACER
+#include <deque>
+#include <functional>
+#include <mutex>
+
+namespace engine
+{
+    /**
+     * Where the pacer gets its time from, in seconds. system() is the real
+     * steady clock; tests and the pacing benchmark plug in a simulated one.
+     * now() is also what the spin-wait polls, so a simulated clock has to
+     * advance a little on every call.
+     */
+    struct FrameClock
+    {
+        std::function<double()> now;
+        std::function<void(double)> sleep;
+
+        static FrameClock system();
+    };
+
+    struct PacingSettings
+    {
+        // 0 means uncapped
+        double targetFrameTime = 1.0 / 60.0;
+        // The last part of the wait is spent spinning, OS sleeps overshoot
+        double spinTime = 0.002;
+        unsigned maxFramesInFlight = 2;
+    };
+
+    struct PacingStats
+    {
+        size_t frames = 0;
+        double averageFrameTime = 0;
+        // Standard deviation of the frame time
+        double frameTimeJitter = 0;
+        // From the start of a frame (input poll) until the GPU finished it
+        double averageLatency = 0;
+        double maxLatency = 0;
+    };
+
+    /**
+     * Paces the main loop to a target frame time and caps how many frames
+     * the CPU may run ahead of the GPU.
+     *
+     * Per frame: waitForNextFrame(), poll input, update, render,
+     * framePresented(). frameCompleted() is called once the GPU is done
+     * with a frame (queue work done callback). Waiting happens before input
+     * is polled so it does not add to the input latency.
+     */
+    class FramePacer
+    {
+        public:
+            FramePacer(PacingSettings settings = PacingSettings{}, FrameClock clock = FrameClock::system());
+
+            // pollGpu is called while waiting for a free frame slot so GPU
+            // callbacks (and with them frameCompleted) can fire
+            void waitForNextFrame(const std::function<void()>& pollGpu = nullptr);
+            void framePresented();
+            void frameCompleted();
+
+            unsigned framesInFlight() const;
+            const PacingSettings& settings() const { return m_settings; }
+            void setSettings(const PacingSettings& settings) { m_settings = settings; }
+            PacingStats stats() const;
+            void resetStats();
+
+        private:
+            PacingSettings m_settings;
+            FrameClock m_clock;
+            double m_frameStart = 0;
+            double m_nextFrame = 0;
+            bool m_started = false;
+
+            mutable std::mutex m_mutex;
+            std::deque<double> m_inFlight; // start times of frames the GPU has not finished
+
+            size_t m_frames = 0;
+            double m_frameTimeSum = 0;
+            double m_frameTimeSumSq = 0;
+            size_t m_latencyCount = 0;
+            double m_latencySum = 0;
+            double m_latencyMax = 0;
+    };
+}
+#endif
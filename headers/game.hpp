@@ -3,6 +3,7 @@
 #include <entt/entt.hpp>
 #include<glm/glm.hpp>
 #include <glm/gtx/string_cast.hpp>
+#include "transform_sync.hpp"
 
 namespace engine::game
 {
@@ -12,8 +13,11 @@ namespace engine::game
             Game();
             ~Game();
             void update();
+            const TransformSync& transformSync() const { return m_transformSync; }
         private:
             entt::registry m_registry;
+            // Declared after m_registry so it disconnects before the registry dies
+            TransformSync m_transformSync;
     };
 
     struct TransformComponent{
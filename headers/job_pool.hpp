@@ -0,0 +1,49 @@
+#ifndef JOB_POOL
+#define JOB_POOL
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace engine
+{
+    /**
+     * Worker threads that are started once and then reused, so per-frame
+     * work does not pay for thread creation. run() hands out job indices to
+     * the workers and the calling thread and returns once all are done.
+     */
+    class JobPool
+    {
+        public:
+            // threads counts the calling thread, so threads - 1 workers are started
+            explicit JobPool(unsigned threads);
+            ~JobPool();
+            JobPool(const JobPool&) = delete;
+            JobPool& operator=(const JobPool&) = delete;
+
+            // Calls job(i) for every i in [0, count), not in any particular order
+            void run(unsigned count, const std::function<void(unsigned)>& job);
+
+            unsigned threads() const { return static_cast<unsigned>(m_workers.size()) + 1; }
+
+        private:
+            void work();
+            void runJobs();
+
+            std::vector<std::thread> m_workers;
+            std::mutex m_mutex;
+            std::condition_variable m_wake;
+            std::condition_variable m_done;
+            bool m_stop = false;
+            // Bumped for every run() so sleeping workers know there is new work
+            size_t m_generation = 0;
+            unsigned m_busyWorkers = 0;
+
+            const std::function<void(unsigned)>* m_job = nullptr;
+            unsigned m_count = 0;
+            std::atomic<unsigned> m_next{ 0 };
+    };
+}
+#endif
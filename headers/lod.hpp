@@ -0,0 +1,120 @@
+#ifndef LOD_SYSTEM
+#define LOD_SYSTEM
+#include <cstdint>
+#include <vector>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+#include "job_pool.hpp"
+
+namespace engine::game
+{
+    struct LODLevel
+    {
+        uint32_t mesh;
+        uint32_t triangleCount;
+        // Used while the projected bounding radius is at least this many pixels
+        float minScreenSize;
+    };
+
+    /**
+     * Mesh variants of one model, finest first. minScreenSize must decrease
+     * from one level to the next; the last level is used below every threshold.
+     */
+    struct LODGroup
+    {
+        std::vector<LODLevel> levels;
+    };
+
+    struct LODComponent
+    {
+        const LODGroup* group = nullptr;
+        float boundingRadius = 1.0f;
+        uint32_t current = 0;
+
+        LODComponent() = default;
+        LODComponent(const LODComponent&) = default;
+        LODComponent(const LODGroup* _group, float _boundingRadius)
+            : group(_group), boundingRadius(_boundingRadius){}
+    };
+
+    struct LODCamera
+    {
+        glm::vec3 position = glm::vec3(0.0f);
+        float verticalFov = glm::radians(60.0f);
+        float viewportHeight = 480.0f;
+    };
+
+    struct LODSettings
+    {
+        // A level only changes once the size is this far (relative) past its threshold
+        float hysteresis = 0.1f;
+        // Hint the next finer level once the size is within this margin of its threshold
+        float prefetchMargin = 0.25f;
+        unsigned threads = 1;
+    };
+
+    struct LODDraw
+    {
+        uint32_t mesh;
+        entt::entity entity;
+    };
+
+    struct PrefetchHint
+    {
+        uint32_t mesh;
+        entt::entity entity;
+    };
+
+    struct LODStats
+    {
+        size_t entities = 0;
+        size_t switches = 0;
+        uint64_t triangles = 0;
+        uint64_t fullDetailTriangles = 0;
+        double selectMs = 0;
+    };
+
+    /**
+     * Picks a level for every entity with a LODComponent and a
+     * TransformComponent from its projected size, splitting the entities
+     * over settings.threads threads. The threads are started once, by the
+     * constructor, and reused by every update.
+     *
+     * The draws come out sorted by mesh, so each run of equal meshes is one
+     * instanced batch.
+     */
+    class LODSystem
+    {
+        public:
+            LODSystem(LODSettings settings = LODSettings{});
+            LODSystem(const LODSystem&) = delete;
+            LODSystem& operator=(const LODSystem&) = delete;
+            void update(entt::registry& registry, const LODCamera& camera);
+
+            const std::vector<LODDraw>& draws() const { return m_draws; }
+            const std::vector<PrefetchHint>& prefetchHints() const { return m_hints; }
+            const LODStats& stats() const { return m_stats; }
+
+            // Projected bounding radius in pixels
+            static float projectedSize(const LODCamera& camera, const glm::vec3& center, float radius);
+            // Level to use at size when currently at current, with hysteresis applied
+            static uint32_t selectLevel(const LODGroup& group, uint32_t current, float size, float hysteresis);
+
+        private:
+            struct Chunk
+            {
+                std::vector<LODDraw> draws;
+                std::vector<PrefetchHint> hints;
+                LODStats stats;
+            };
+
+            LODSettings m_settings;
+            JobPool m_jobs;
+            std::vector<entt::entity> m_entities;
+            std::vector<Chunk> m_chunks;
+            std::vector<LODDraw> m_draws;
+            std::vector<PrefetchHint> m_hints;
+            LODStats m_stats;
+    };
+}
+#endif
@@ -1,19 +1,62 @@
+#ifndef RENDERER
+#define RENDERER
 #include <webgpu/webgpu.hpp>
+#include <atomic>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <glfw/glfw3.h>
+#include "transform_sync.hpp"
+#include "webgpu_procs.hpp"
 
 class Renderer
 {
 public:
-    Renderer(GLFWwindow* window);
+    // Creates nothing, the init stages are run by the startup graph (see buildRendererStages in startup.hpp).
+    // The init stages and the destructor go through procs, so they can run on a mock device.
+    Renderer(const WebGPUProcs& procs = webgpuProcs());
     ~Renderer();
+
+    void initInstance();
+    void initSurface(GLFWwindow* window);
+    void initAdapter();
+    void initDevice();
+    void initSwapChain();
+    void initPipeline(const std::string& shaderSource);
+    static std::string loadShaderSource(const std::string& path);
+
     void render(WGPUColor color);
+    // Both only flag the swap chain, it is recreated at the start of the next render().
+    // A present mode the surface does not support falls back to Fifo, which always is.
+    void resize(uint32_t width, uint32_t height);
+    void setPresentMode(WGPUPresentMode mode);
+    WGPUPresentMode getPresentMode() const { return presentMode; }
+    // Called once the GPU is done with everything submitted so far
+    void onSubmittedWorkDone(WGPUQueueWorkDoneCallback callback, void* userData);
+    // Push the ranges gathered by the last TransformSync::sync() to the GPU
+    void uploadTransforms(const engine::game::TransformSync& sync);
     std::unique_ptr<WGPUDevice> device;
 private:
+    const WebGPUProcs& gpu;
     std::unique_ptr<WGPUSwapChain> swapChain;
     std::unique_ptr<WGPUAdapter> adapter;
     std::unique_ptr<WGPUSurface> surface;
     std::unique_ptr<WGPUInstance> instance;
     std::unique_ptr<WGPURenderPipeline> pipeline;
     std::unique_ptr<WGPUQueue> queue;
-};
\ No newline at end of file
+    WGPUBuffer transformBuffer = nullptr;
+    WGPUBuffer vertexBuffer = nullptr;
+    uint32_t vertexCount = 0;
+    uint32_t transformCapacity = 0;
+    WGPUTextureFormat swapChainFormat = WGPUTextureFormat_BGRA8Unorm;
+    uint32_t width = 640;
+    uint32_t height = 480;
+    WGPUPresentMode presentMode = WGPUPresentMode_Fifo;
+    bool swapChainOutdated = false;
+    // Set by the error scope around swap chain creation, whose result arrives asynchronously
+    std::atomic<bool> swapChainRejected{ false };
+    bool fallBackToFifo();
+    // initSwapChain and initPipeline may run at the same time, the device is not thread safe
+    std::mutex deviceMutex;
+};
+#endif
\ No newline at end of file
@@ -0,0 +1,90 @@
+#ifndef STARTUP
+#define STARTUP
+#include <chrono>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "renderer.hpp"
+
+namespace engine::startup
+{
+    enum class Affinity
+    {
+        Any,  // may run on any job thread
+        Main  // must run on the thread that calls run() (GLFW, surface, ...)
+    };
+
+    /**
+     * Startup expressed as a dependency graph. Tasks whose dependencies are
+     * done run concurrently on job threads, Main tasks run on the calling
+     * thread, which also helps out with Any tasks while it has nothing else
+     * to do, but never with one that has a shorter chain behind it than a
+     * Main task still to come. Among ready tasks the one with the longest
+     * chain of dependents goes first, so the critical chain is not stuck
+     * behind side work.
+     *
+     * Every task is timed relative to the start of run() so the report shows
+     * when each stage started/ended and which chain of tasks was critical.
+     */
+    class StartupGraph
+    {
+        public:
+            using TaskId = size_t;
+
+            TaskId add(const std::string& name, std::function<void()> fn,
+                       std::vector<TaskId> dependencies = {}, Affinity affinity = Affinity::Any);
+
+            // Runs every task, rethrows the first exception a task threw.
+            // Always uses at least one job thread besides the caller.
+            void run(unsigned jobThreads);
+
+            // Seconds since run() was called
+            double elapsed() const;
+            double totalTime() const { return m_totalTime; }
+            // The dependency chain with the largest summed task time, first to
+            // last: no number of threads can start up faster than this
+            std::vector<TaskId> criticalPath() const;
+            double criticalPathTime() const;
+            void report(std::ostream& out) const;
+
+        private:
+            struct Task
+            {
+                std::string name;
+                std::function<void()> fn;
+                std::vector<TaskId> dependencies;
+                std::vector<TaskId> dependents;
+                Affinity affinity;
+                double start = 0;
+                double end = 0;
+            };
+
+            std::vector<Task> m_tasks;
+            std::chrono::steady_clock::time_point m_startTime;
+            double m_totalTime = 0;
+    };
+
+    /**
+     * One callback per startup stage. buildRendererStages() fills the GPU
+     * ones from a Renderer, the caller adds window and scene.
+     */
+    struct StartupStages
+    {
+        std::function<void()> window;
+        std::function<void()> instance;
+        std::function<void()> surface;
+        std::function<void()> adapter;
+        std::function<void()> device;
+        std::function<void()> swapChain;
+        std::function<void()> shaderSource;
+        std::function<void()> pipeline;
+        std::function<void()> scene;
+    };
+
+    void buildStartupGraph(StartupGraph& graph, const StartupStages& stages);
+
+    // window is read when the surface stage runs, so it can be set by the window stage
+    StartupStages buildRendererStages(Renderer& renderer, GLFWwindow*& window, std::string& shaderSource);
+}
+#endif
@@ -0,0 +1,97 @@
+#ifndef TRANSFORM_SYNC
+#define TRANSFORM_SYNC
+#include <cstdint>
+#include <vector>
+#include <entt/entt.hpp>
+#include <glm/glm.hpp>
+
+namespace engine::game
+{
+    struct TransformComponent;
+
+    /**
+     * A contiguous run of GPU slots that has to be re-uploaded, in slots
+     * (one slot = one glm::mat4).
+     */
+    struct UploadRange
+    {
+        uint32_t firstSlot;
+        uint32_t slotCount;
+    };
+
+    // An entity that was moved to another slot to fill the hole of a destroyed one
+    struct SlotMove
+    {
+        entt::entity entity;
+        uint32_t fromSlot;
+        uint32_t toSlot;
+    };
+
+    struct SyncStats
+    {
+        size_t dirtySlots = 0;
+        size_t ranges = 0;
+        size_t bytesUploaded = 0;
+        bool fullUpload = false;
+    };
+
+    /**
+     * Mirrors every TransformComponent into a densely packed array that has
+     * the same layout as the GPU transform buffer.
+     *
+     * Changes are picked up through the registry's on_construct / on_update /
+     * on_destroy signals, so only entities that were emplaced, patched or
+     * replaced are re-uploaded. Writing through registry.get<>() bypasses
+     * on_update and will NOT be seen here; use registry.patch<>() instead.
+     *
+     * On destroy the last slot is moved into the hole so the buffer stays
+     * compact, which changes the slot of the entity that lived there. Anything
+     * that keeps slotOf() around has to re-point it using movedSlots().
+     */
+    class TransformSync
+    {
+        public:
+            TransformSync(entt::registry& registry);
+            ~TransformSync();
+            TransformSync(const TransformSync&) = delete;
+            TransformSync& operator=(const TransformSync&) = delete;
+
+            // Gather dirty slots into upload ranges. Two dirty slots closer
+            // than maxGap clean slots are merged into one range.
+            const SyncStats& sync(uint32_t maxGap = 4);
+
+            const std::vector<UploadRange>& ranges() const { return m_ranges; }
+            // Slot moves since the previous sync(), in the order they happened
+            const std::vector<SlotMove>& movedSlots() const { return m_moved; }
+            const glm::mat4* data() const { return m_slots.data(); }
+            uint32_t slotCount() const { return static_cast<uint32_t>(m_slots.size()); }
+            // Number of slots the GPU buffer has to hold, grows by doubling
+            uint32_t capacity() const { return m_capacity; }
+            const SyncStats& stats() const { return m_stats; }
+            // Slot of entity, or InvalidSlot if it has no TransformComponent
+            uint32_t slotOf(entt::entity entity) const;
+
+            static constexpr uint32_t InvalidSlot = ~0u;
+
+        private:
+            void onConstruct(entt::registry& registry, entt::entity entity);
+            void onUpdate(entt::registry& registry, entt::entity entity);
+            void onDestroy(entt::registry& registry, entt::entity entity);
+            void markDirty(uint32_t slot);
+
+            entt::registry& m_registry;
+            std::vector<glm::mat4> m_slots;
+            std::vector<entt::entity> m_slotToEntity;
+            std::vector<uint32_t> m_entityToSlot;
+            std::vector<uint8_t> m_dirty;
+            std::vector<uint32_t> m_dirtyList;
+            std::vector<UploadRange> m_ranges;
+            std::vector<SlotMove> m_moved;
+            // Moves made since the last sync(), handed over to m_moved by sync()
+            std::vector<SlotMove> m_pendingMoves;
+            uint32_t m_capacity = 0;
+            bool m_resized = false;
+            SyncStats m_stats;
+    };
+}
+#endif
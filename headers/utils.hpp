@@ -1,12 +1,50 @@
 #ifndef UTILS
 #define UTILS
+#include <chrono>
+#include <future>
+#include <thread>
+#include <webgpu/webgpu.hpp>
+#include "webgpu_procs.hpp"
+
+/**
+ * Asynchronous versions of requestAdapter/requestDevice. The returned future
+ * is fulfilled from the WebGPU callback, with nullptr on failure. Callbacks
+ * are only delivered while events are processed, see awaitCallback.
+ */
+std::future<WGPUAdapter> requestAdapterAsync(WGPUInstance instance, WGPURequestAdapterOptions const * options,
+                                             const WebGPUProcs& procs = webgpuProcs());
+std::future<WGPUDevice> requestDeviceAsync(WGPUAdapter adapter, WGPUDeviceDescriptor const * descriptor,
+                                           const WebGPUProcs& procs = webgpuProcs());
+
+/**
+ * Let the instance deliver pending callbacks (no-op on wgpu-native, which
+ * calls them right away)
+ */
+void processEvents(WGPUInstance instance);
+
+/**
+ * Block until a future from a WebGPU callback is ready, processing instance
+ * events in the meantime so the callback actually gets a chance to fire.
+ */
+template<typename T>
+T awaitCallback(WGPUInstance instance, std::future<T>& future, const WebGPUProcs& procs = webgpuProcs())
+{
+    while (future.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+    {
+        procs.instanceProcessEvents(instance);
+        std::this_thread::yield();
+    }
+    return future.get();
+}
+
 /**
  * Utility function to get a WebGPU adapter, so that
  *     WGPUAdapter adapter = requestAdapter(options);
  * is roughly equivalent to
  *     const adapter = await navigator.gpu.requestAdapter(options);
  */
-WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions const * options);
+WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions const * options,
+                           const WebGPUProcs& procs = webgpuProcs());
 
 /**
  * Utility function to get a WebGPU device, so that
@@ -15,5 +53,6 @@ WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions cons
  *     const device = await adapter.requestDevice(descriptor);
  * It is very similar to requestAdapter
  */
-WGPUDevice requestDevice(WGPUAdapter adapter, WGPUDeviceDescriptor const * descriptor);
+WGPUDevice requestDevice(WGPUInstance instance, WGPUAdapter adapter, WGPUDeviceDescriptor const * descriptor,
+                         const WebGPUProcs& procs = webgpuProcs());
 #endif
\ No newline at end of file
@@ -0,0 +1,64 @@
+#ifndef WEBGPU_PROCS
+#define WEBGPU_PROCS
+#include <webgpu/webgpu.hpp>
+#include <glfw/glfw3.h>
+#include <glfw3webgpu.h>
+
+/**
+ * The WebGPU calls made by the Renderer init stages, as a table so startup
+ * can run against a mock device. Per-frame rendering calls WebGPU directly.
+ */
+struct WebGPUProcs
+{
+    decltype(&wgpuCreateInstance) createInstance;
+    decltype(&glfwGetWGPUSurface) createSurface;
+    decltype(&wgpuInstanceRequestAdapter) instanceRequestAdapter;
+    void (*instanceProcessEvents)(WGPUInstance instance);
+    decltype(&wgpuAdapterEnumerateFeatures) adapterEnumerateFeatures;
+    decltype(&wgpuAdapterGetLimits) adapterGetLimits;
+    decltype(&wgpuAdapterRequestDevice) adapterRequestDevice;
+    decltype(&wgpuDeviceGetLimits) deviceGetLimits;
+    decltype(&wgpuDeviceSetUncapturedErrorCallback) deviceSetUncapturedErrorCallback;
+    decltype(&wgpuDevicePushErrorScope) devicePushErrorScope;
+    decltype(&wgpuDevicePopErrorScope) devicePopErrorScope;
+    decltype(&wgpuDeviceGetQueue) deviceGetQueue;
+    decltype(&wgpuQueueOnSubmittedWorkDone) queueOnSubmittedWorkDone;
+    decltype(&wgpuDeviceCreateSwapChain) deviceCreateSwapChain;
+    decltype(&wgpuDeviceCreateShaderModule) deviceCreateShaderModule;
+    decltype(&wgpuDeviceCreateRenderPipeline) deviceCreateRenderPipeline;
+    decltype(&wgpuDeviceCreateBuffer) deviceCreateBuffer;
+    decltype(&wgpuQueueWriteBuffer) queueWriteBuffer;
+
+    decltype(&wgpuShaderModuleRelease) shaderModuleRelease;
+    decltype(&wgpuBufferRelease) bufferRelease;
+    decltype(&wgpuRenderPipelineRelease) renderPipelineRelease;
+    decltype(&wgpuSwapChainRelease) swapChainRelease;
+    decltype(&wgpuQueueRelease) queueRelease;
+    decltype(&wgpuDeviceRelease) deviceRelease;
+    decltype(&wgpuAdapterRelease) adapterRelease;
+    decltype(&wgpuSurfaceRelease) surfaceRelease;
+    decltype(&wgpuInstanceRelease) instanceRelease;
+};
+
+// The real WebGPU implementation
+const WebGPUProcs& webgpuProcs();
+
+// How long the mock device takes for each step, in seconds
+struct MockDeviceTimings
+{
+    double instance = 0.020;
+    double adapter = 0.040;
+    double device = 0.060;
+    double swapChain = 0.010;
+    double shaderModule = 0.015;
+    double pipeline = 0.050;
+};
+
+/**
+ * A device that only takes time. Adapter and device requests complete
+ * asynchronously: their callbacks fire from instanceProcessEvents once the
+ * delay has passed, like Dawn's do. Creation calls block for their delay
+ * and return dummy handles that must never reach the real WebGPU.
+ */
+const WebGPUProcs& mockWebGPUProcs(MockDeviceTimings timings = MockDeviceTimings{});
+#endif
@@ -1,8 +1,223 @@
-
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+#include <thread>
 #include "engine.hpp"
+#include "startup.hpp"
+#include "game.hpp"
+#include "lod.hpp"
+#include "frame_pacer.hpp"
+
+// Runs the real Renderer init stages on a mock device, no window or GPU
+// needed, to look at the critical path of startup
+void runHeadlessStartup()
+{
+    Renderer renderer(mockWebGPUProcs());
+    GLFWwindow* window = nullptr;
+    std::string shaderSource;
+    std::unique_ptr<engine::game::Game> game;
+
+    engine::startup::StartupStages stages = engine::startup::buildRendererStages(renderer, window, shaderSource);
+    stages.window = []() {};
+    stages.scene = [&]() { game = std::make_unique<engine::game::Game>(); };
+
+    engine::startup::StartupGraph graph;
+    engine::startup::buildStartupGraph(graph, stages);
+    graph.run(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    graph.report(std::cout);
+}
+
+// Patches a share of a million transforms per frame, scattered or in one
+// block, and compares what sync() uploads against re-uploading everything
+void runTransformSyncBenchmark()
+{
+    using namespace engine::game;
+    const int entityCount = 1000000;
+    const int frames = 20;
+
+    entt::registry registry;
+    TransformSync transformSync(registry);
+    std::vector<entt::entity> entities;
+    entities.reserve(entityCount);
+    for (int i = 0; i < entityCount; i++)
+    {
+        entt::entity entity = registry.create();
+        registry.emplace<TransformComponent>(entity, glm::mat4(1.0f));
+        entities.push_back(entity);
+    }
+    // The first sync uploads everything
+    transformSync.sync();
+    const size_t fullBytes = static_cast<size_t>(transformSync.slotCount()) * sizeof(glm::mat4);
+
+    std::mt19937 rng(3);
+    auto move = [](TransformComponent& transform) { transform.transform[3][0] += 1.0f; };
+    for (bool clustered : { false, true })
+    {
+        for (double fraction : { 0.001, 0.01, 0.1 })
+        {
+            const int changed = static_cast<int>(entityCount * fraction);
+            std::uniform_int_distribution<int> pick(0, entityCount - 1);
+            std::uniform_int_distribution<int> blockStart(0, entityCount - changed);
+            double totalMs = 0;
+            size_t ranges = 0;
+            size_t bytes = 0;
+            for (int frame = 0; frame < frames; frame++)
+            {
+                if (clustered)
+                {
+                    int first = blockStart(rng);
+                    for (int i = first; i < first + changed; i++)
+                        registry.patch<TransformComponent>(entities[i], move);
+                }
+                else
+                {
+                    for (int i = 0; i < changed; i++)
+                        registry.patch<TransformComponent>(entities[pick(rng)], move);
+                }
+
+                auto start = std::chrono::steady_clock::now();
+                const SyncStats& stats = transformSync.sync();
+                totalMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+                ranges += stats.ranges;
+                bytes += stats.bytesUploaded;
+            }
+
+            std::cout << (clustered ? "clustered " : "random ") << fraction * 100.0 << "%: sync "
+                      << totalMs / frames << " ms, " << ranges / frames << " ranges, "
+                      << bytes / frames << " of " << fullBytes << " bytes ("
+                      << 100.0 * double(bytes / frames) / double(fullBytes) << "% of a full upload)" << std::endl;
+        }
+    }
+}
+
+// Runs LOD selection over a million synthetic entities with a moving camera
+void runLODBenchmark()
+{
+    using namespace engine::game;
+    const int entityCount = 1000000;
+    const int frames = 120;
+
+    LODGroup group{ { { 0, 5000, 200.0f }, { 1, 1200, 60.0f }, { 2, 300, 15.0f }, { 3, 50, 0.0f } } };
+    entt::registry registry;
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<float> position(-500.0f, 500.0f);
+    for (int i = 0; i < entityCount; i++)
+    {
+        glm::mat4 transform(1.0f);
+        transform[3] = glm::vec4(position(rng), position(rng), position(rng), 1.0f);
+        entt::entity entity = registry.create();
+        registry.emplace<TransformComponent>(entity, transform);
+        registry.emplace<LODComponent>(entity, &group, 20.0f);
+    }
+
+    LODSystem lodSystem(LODSettings{ 0.1f, 0.25f, std::max(1u, std::thread::hardware_concurrency()) });
+    LODCamera camera;
+    double totalMs = 0;
+    size_t switches = 0;
+    size_t hints = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        camera.position = glm::vec3(0.0f, 0.0f, -500.0f + frame * 8.0f);
+        lodSystem.update(registry, camera);
+        // The first frame moves everything off level 0, it is not representative
+        if (frame == 0) continue;
+        totalMs += lodSystem.stats().selectMs;
+        switches += lodSystem.stats().switches;
+        hints += lodSystem.prefetchHints().size();
+    }
+
+    const LODStats& stats = lodSystem.stats();
+    double perMillion = totalMs / (frames - 1) * 1000000.0 / stats.entities;
+    std::cout << "LOD selection: " << perMillion << " ms per million entities per frame" << std::endl;
+    std::cout << "Switches per frame: " << switches / (frames - 1)
+              << " Prefetch hints per frame: " << hints / (frames - 1) << std::endl;
+    std::cout << "Triangles: " << stats.triangles << " of " << stats.fullDetailTriangles
+              << " (" << 100.0 * (1.0 - double(stats.triangles) / double(stats.fullDetailTriangles)) << "% fewer)" << std::endl;
+}
+
+// Runs the frame pacer against a simulated clock, CPU and GPU and prints
+// frame time jitter and latency for a few settings
+void runPacingBenchmark()
+{
+    struct Scenario
+    {
+        const char* name;
+        engine::PacingSettings settings;
+    };
+    const Scenario scenarios[] = {
+        { "uncapped, 8 in flight", { 0.0, 0.0, 8 } },
+        { "uncapped, 1 in flight", { 0.0, 0.0, 1 } },
+        { "60Hz sleep only", { 1.0 / 60.0, 0.0, 2 } },
+        { "60Hz sleep + spin", { 1.0 / 60.0, 0.002, 2 } },
+    };
+
+    for (const Scenario& scenario : scenarios)
+    {
+        double time = 0;
+        std::mt19937 rng(7);
+        // OS sleeps wake up to 1.5ms late
+        std::uniform_real_distribution<double> oversleep(0.0, 0.0015);
+        std::uniform_real_distribution<double> cpuWork(0.003, 0.005);
+
+        engine::FrameClock clock;
+        clock.now = [&]() { time += 1e-6; return time; };
+        clock.sleep = [&](double seconds) { time += seconds + oversleep(rng); };
+        engine::FramePacer pacer(scenario.settings, clock);
+
+        // The simulated GPU takes 10ms per frame, one frame at a time
+        const double gpuTime = 0.010;
+        double gpuFree = 0;
+        std::deque<double> gpuDone;
+        auto pollGpu = [&]() {
+            while (!gpuDone.empty() && gpuDone.front() <= time)
+            {
+                gpuDone.pop_front();
+                pacer.frameCompleted();
+            }
+        };
+
+        for (int frame = 0; frame < 2000; frame++)
+        {
+            pacer.waitForNextFrame(pollGpu);
+            time += cpuWork(rng);
+            gpuFree = std::max(gpuFree, time) + gpuTime;
+            gpuDone.push_back(gpuFree);
+            pacer.framePresented();
+            pollGpu();
+        }
+
+        engine::PacingStats stats = pacer.stats();
+        std::cout << scenario.name << ": frame " << stats.averageFrameTime * 1000.0 << " ms"
+                  << " jitter " << stats.frameTimeJitter * 1000.0 << " ms"
+                  << " latency " << stats.averageLatency * 1000.0 << " ms (max " << stats.maxLatency * 1000.0 << " ms)" << std::endl;
+    }
+}
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
+    if (argc > 1 && std::strcmp(argv[1], "--headless-startup") == 0)
+    {
+        runHeadlessStartup();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--transform-sync-benchmark") == 0)
+    {
+        runTransformSyncBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--lod-benchmark") == 0)
+    {
+        runLODBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::strcmp(argv[1], "--pacing-benchmark") == 0)
+    {
+        runPacingBenchmark();
+        return 0;
+    }
 
     engine::Engine engine;
     
@@ -1,4 +1,6 @@
+#include <algorithm>
 #include <iostream>
+#include <thread>
 #include <glfw/glfw3.h>
 #include <webgpu/webgpu.hpp>
 #include <glfw3webgpu.h>
@@ -6,6 +8,7 @@
 #include "engine.hpp"
 #include "time.hpp"
 #include "game.hpp"
+#include "startup.hpp"
 
 // If using Dawn
 #ifndef WEBGPU_BACKEND_DAWN
@@ -15,7 +18,7 @@
 namespace engine
 {
 
-void createWindow(GLFWwindow** window)
+void createWindow(GLFWwindow** window, int width, int height)
 {
     if(!glfwInit())
     {
@@ -24,26 +27,98 @@ void createWindow(GLFWwindow** window)
     }
 
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API); // NEW
-    *window = glfwCreateWindow(640, 480, "Learn WebGPU", NULL, NULL);
-    if (!window)
+    *window = glfwCreateWindow(width, height, "Learn WebGPU", NULL, NULL);
+    if (!*window)
     {
         std::cerr<<"Could not create window!" << std::endl;
-        glfwTerminate();
         throw std::exception();
     }
 }
 
 Engine::Engine()
 {
-    createWindow(&window);
-    game::Game game;
-    //Renderer rend(window);
-    //renderer = &rend;
+    startup::StartupGraph graph;
+    std::string shaderSource;
+    renderer = std::make_unique<Renderer>();
+
+    startup::StartupStages stages = startup::buildRendererStages(*renderer, window, shaderSource);
+    stages.window = [&]() {
+        createWindow(&window, 640, 480);
+        int width, height;
+        glfwGetFramebufferSize(window, &width, &height);
+        renderer->resize(width, height);
+    };
+    stages.scene = [&]() { game = std::make_unique<game::Game>(); };
+    startup::buildStartupGraph(graph, stages);
+
+    // The main thread takes part too, so leave one core for it
+    try
+    {
+        graph.run(std::max(2u, std::thread::hardware_concurrency()) - 1);
+    }
+    catch (...)
+    {
+        // Whatever did get created has to go before GLFW does, the surface belongs to the window
+        game.reset();
+        renderer.reset();
+        if (window) glfwDestroyWindow(window);
+        glfwTerminate();
+        throw;
+    }
+    graph.report(std::cout);
+    bool firstFrame = true;
+
+    #pragma region frame pacing
+    // Cap to the monitor refresh rate, more frames would never be shown anyway
+    const GLFWvidmode* videoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+    PacingSettings pacing;
+    if (videoMode && videoMode->refreshRate > 0) pacing.targetFrameTime = 1.0 / videoMode->refreshRate;
+    cappedFrameTime = pacing.targetFrameTime;
+    pacer.setSettings(pacing);
+
+    glfwSetWindowUserPointer(window, this);
+    glfwSetFramebufferSizeCallback(window, [](GLFWwindow* window, int width, int height) {
+        Engine& engine = *reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
+        engine.renderer->resize(width, height);
+    });
+    // F1/F2/F3 switch between Fifo, Mailbox and Immediate, F4 toggles the frame cap
+    glfwSetKeyCallback(window, [](GLFWwindow* window, int key, int /* scancode */, int action, int /* mods */) {
+        if (action != GLFW_PRESS) return;
+        Engine& engine = *reinterpret_cast<Engine*>(glfwGetWindowUserPointer(window));
+        if (key == GLFW_KEY_F1) engine.renderer->setPresentMode(WGPUPresentMode_Fifo);
+        if (key == GLFW_KEY_F2) engine.renderer->setPresentMode(WGPUPresentMode_Mailbox);
+        if (key == GLFW_KEY_F3) engine.renderer->setPresentMode(WGPUPresentMode_Immediate);
+        if (key == GLFW_KEY_F4)
+        {
+            PacingSettings settings = engine.pacer.settings();
+            settings.targetFrameTime = settings.targetFrameTime > 0 ? 0.0 : engine.cappedFrameTime;
+            engine.pacer.setSettings(settings);
+        }
+    });
+    auto onFrameDone = [](WGPUQueueWorkDoneStatus /* status */, void* pUserData) {
+        reinterpret_cast<FramePacer*>(pUserData)->frameCompleted();
+    };
+    #pragma endregion
+
+    // Do nothing, this checks for ongoing asynchronous operations and call their callbacks
+    auto tick = [&]() {
+        #ifdef WEBGPU_BACKEND_WGPU
+            // Non-standardized behavior: submit empty queue to flush callbacks
+            // (wgpu-native also has a wgpuDevicePoll but its API is more complex)
+            wgpuQueueSubmit(queue, 0, nullptr);
+        #else
+            // Non-standard Dawn way
+            wgpuDeviceTick(*(renderer->device));
+        #endif
+    };
+
     double lastFrameTime = glfwGetTime(); // Time of last frame
     engine::time::timeSinceStart = lastFrameTime;
     double timeElapsedSinceLastSecond = 0;
     int framesElapsedSinceLastSecond = 0;
     while (!glfwWindowShouldClose(window)) {
+        // Wait before polling so the input we read is as fresh as possible at present
+        pacer.waitForNextFrame(tick);
         glfwPollEvents();
         double currTime = glfwGetTime();
         engine::time::deltaTime = currTime - lastFrameTime;
@@ -57,22 +132,29 @@ Engine::Engine()
             engine::time::framesPerSecond = framesElapsedSinceLastSecond;
             timeElapsedSinceLastSecond = 0;
             framesElapsedSinceLastSecond = 0;
+
+            PacingStats stats = pacer.stats();
+            std::cout << "Frame: " << stats.averageFrameTime * 1000.0 << " ms, jitter " << stats.frameTimeJitter * 1000.0
+                      << " ms, latency " << stats.averageLatency * 1000.0 << " ms" << std::endl;
+            pacer.resetStats();
         }
         // update
-        game.update();
+        game->update();
+        renderer->uploadTransforms(game->transformSync());
 
-        // Do nothing, this checks for ongoing asynchronous operations and call their callbacks
-        #ifdef WEBGPU_BACKEND_WGPU
-            // Non-standardized behavior: submit empty queue to flush callbacks
-            // (wgpu-native also has a wgpuDevicePoll but its API is more complex)
-            wgpuQueueSubmit(queue, 0, nullptr);
-        #else
-            // Non-standard Dawn way
-            //WGPUDevice d = *(renderer->device);
-            //wgpuDeviceTick( d );
-        #endif
-    	//renderer->render(WGPUColor{ 0.9, 0.2, 0.2, 1.0 });	
+        tick();
+    	renderer->render(WGPUColor{ 0.9, 0.2, 0.2, 1.0 });
+        // Before registering the callback, wgpu-native may call it right away
+        pacer.framePresented();
+        renderer->onSubmittedWorkDone(onFrameDone, &pacer);
+        if (firstFrame)
+        {
+            std::cout << "Time to first frame: " << graph.elapsed() * 1000.0 << " ms" << std::endl;
+            firstFrame = false;
+        }
 	}
+    game.reset();
+    renderer.reset();
     glfwDestroyWindow(window);
     glfwTerminate();
 }
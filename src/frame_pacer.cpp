@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <thread>
+#include "frame_pacer.hpp"
+
+namespace engine
+{
+
+FrameClock FrameClock::system()
+{
+    FrameClock clock;
+    clock.now = []() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    };
+    clock.sleep = [](double seconds) {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    };
+    return clock;
+}
+
+FramePacer::FramePacer(PacingSettings settings, FrameClock clock)
+    : m_settings(settings), m_clock(std::move(clock))
+{
+}
+
+unsigned FramePacer::framesInFlight() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return static_cast<unsigned>(m_inFlight.size());
+}
+
+void FramePacer::waitForNextFrame(const std::function<void()>& pollGpu)
+{
+    // Don't let the CPU queue up more frames than allowed, every queued
+    // frame is a frame of extra latency
+    while (framesInFlight() >= std::max(1u, m_settings.maxFramesInFlight))
+    {
+        if (pollGpu) pollGpu();
+        if (framesInFlight() >= std::max(1u, m_settings.maxFramesInFlight)) m_clock.sleep(0.0002);
+    }
+
+    double now = m_clock.now();
+    if (m_started && m_settings.targetFrameTime > 0)
+    {
+        // Sleep most of the way, then spin for the rest since sleeps overshoot
+        double remaining = m_nextFrame - now;
+        if (remaining > m_settings.spinTime)
+        {
+            m_clock.sleep(remaining - m_settings.spinTime);
+        }
+        now = m_clock.now();
+        while (now < m_nextFrame)
+        {
+            now = m_clock.now();
+        }
+    }
+
+    if (m_started)
+    {
+        double frameTime = now - m_frameStart;
+        m_frames++;
+        m_frameTimeSum += frameTime;
+        m_frameTimeSumSq += frameTime * frameTime;
+    }
+
+    // Fell behind by more than a frame: start over instead of rushing to catch up
+    double target = m_settings.targetFrameTime;
+    if (!m_started || now > m_nextFrame + target) m_nextFrame = now + target;
+    else m_nextFrame += target;
+
+    m_frameStart = now;
+    m_started = true;
+}
+
+void FramePacer::framePresented()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_inFlight.push_back(m_frameStart);
+}
+
+void FramePacer::frameCompleted()
+{
+    double now = m_clock.now();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_inFlight.empty()) return;
+
+    double latency = now - m_inFlight.front();
+    m_inFlight.pop_front();
+    m_latencyCount++;
+    m_latencySum += latency;
+    m_latencyMax = std::max(m_latencyMax, latency);
+}
+
+PacingStats FramePacer::stats() const
+{
+    PacingStats stats;
+    stats.frames = m_frames;
+    if (m_frames > 0)
+    {
+        stats.averageFrameTime = m_frameTimeSum / m_frames;
+        double variance = m_frameTimeSumSq / m_frames - stats.averageFrameTime * stats.averageFrameTime;
+        stats.frameTimeJitter = std::sqrt(std::max(0.0, variance));
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_latencyCount > 0)
+    {
+        stats.averageLatency = m_latencySum / m_latencyCount;
+        stats.maxLatency = m_latencyMax;
+    }
+    return stats;
+}
+
+void FramePacer::resetStats()
+{
+    m_frames = 0;
+    m_frameTimeSum = 0;
+    m_frameTimeSumSq = 0;
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_latencyCount = 0;
+    m_latencySum = 0;
+    m_latencyMax = 0;
+}
+
+}
@@ -5,6 +5,7 @@
 using namespace engine::game;
 
 Game::Game()
+    : m_transformSync(m_registry)
 {
 }
 
@@ -33,7 +34,9 @@ void Game::update()
 {
     addEntity(m_registry, glm::mat4(1.0f));
     updateEntities(m_registry);
+    const SyncStats& sync = m_transformSync.sync();
 
     if ( (int)time::timeSinceStart % 5 == 0)
-        std::cout << "Entities: " << m_registry.size() << " FPS: " << time::framesPerSecond << std::endl;
+        std::cout << "Entities: " << m_registry.size() << " FPS: " << time::framesPerSecond
+                  << " Transform upload: " << sync.bytesUploaded << " bytes in " << sync.ranges << " ranges" << std::endl;
 }
\ No newline at end of file
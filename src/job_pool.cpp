@@ -0,0 +1,82 @@
+#include <algorithm>
+#include "job_pool.hpp"
+
+namespace engine
+{
+
+JobPool::JobPool(unsigned threads)
+{
+    for (unsigned i = 1; i < std::max(1u, threads); i++)
+    {
+        m_workers.emplace_back(&JobPool::work, this);
+    }
+}
+
+JobPool::~JobPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& worker : m_workers)
+    {
+        worker.join();
+    }
+}
+
+void JobPool::runJobs()
+{
+    for (unsigned i = m_next++; i < m_count; i = m_next++)
+    {
+        (*m_job)(i);
+    }
+}
+
+void JobPool::work()
+{
+    size_t generation = 0;
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_wake.wait(lock, [&]() { return m_stop || m_generation != generation; });
+        if (m_stop) return;
+        generation = m_generation;
+
+        lock.unlock();
+        runJobs();
+        lock.lock();
+
+        if (--m_busyWorkers == 0) m_done.notify_one();
+    }
+}
+
+void JobPool::run(unsigned count, const std::function<void(unsigned)>& job)
+{
+    if (count == 0) return;
+    if (m_workers.empty() || count == 1)
+    {
+        for (unsigned i = 0; i < count; i++) job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_count = count;
+        m_next = 0;
+        m_busyWorkers = static_cast<unsigned>(m_workers.size());
+        m_generation++;
+    }
+    m_wake.notify_all();
+
+    runJobs();
+
+    // Every worker has to check in, even if it found nothing left to do,
+    // before job and the counters can be reused
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&]() { return m_busyWorkers == 0; });
+    m_job = nullptr;
+}
+
+}
@@ -0,0 +1,123 @@
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include "lod.hpp"
+#include "game.hpp"
+
+using namespace engine::game;
+
+LODSystem::LODSystem(LODSettings settings)
+    : m_settings(settings), m_jobs(std::max(1u, settings.threads))
+{
+}
+
+float LODSystem::projectedSize(const LODCamera& camera, const glm::vec3& center, float radius)
+{
+    float distance = glm::length(center - camera.position);
+    if (distance <= radius) return camera.viewportHeight; // camera is inside the bounds
+    return radius / (distance * std::tan(camera.verticalFov * 0.5f)) * camera.viewportHeight * 0.5f;
+}
+
+uint32_t LODSystem::selectLevel(const LODGroup& group, uint32_t current, float size, float hysteresis)
+{
+    const std::vector<LODLevel>& levels = group.levels;
+    uint32_t last = static_cast<uint32_t>(levels.size() - 1);
+    current = std::min(current, last);
+
+    // Going finer needs the size to be clearly above the finer threshold
+    for (uint32_t i = 0; i < current; i++)
+    {
+        if (size >= levels[i].minScreenSize * (1.0f + hysteresis)) return i;
+    }
+
+    // Going coarser needs the size to be clearly below the current threshold
+    if (current == last || size >= levels[current].minScreenSize * (1.0f - hysteresis)) return current;
+    for (uint32_t i = current + 1; i < last; i++)
+    {
+        if (size >= levels[i].minScreenSize * (1.0f - hysteresis)) return i;
+    }
+    return last;
+}
+
+void LODSystem::update(entt::registry& registry, const LODCamera& camera)
+{
+    auto start = std::chrono::steady_clock::now();
+
+    auto view = registry.view<LODComponent, TransformComponent>();
+    m_entities.assign(view.begin(), view.end());
+
+    // Not worth waking a thread for less than a few thousand entities
+    size_t minChunk = 4096;
+    unsigned threads = static_cast<unsigned>(std::min<size_t>(m_jobs.threads(),
+                                                               std::max<size_t>(1, m_entities.size() / minChunk)));
+    size_t chunkSize = (m_entities.size() + threads - 1) / threads;
+    m_chunks.resize(threads);
+
+    auto select = [&](unsigned chunkIndex) {
+        // Work on locals and only write back to the chunk at the end, the
+        // chunks of different threads sit next to each other in memory.
+        // Swapping the vectors in and out keeps their capacity between frames
+        Chunk& chunk = m_chunks[chunkIndex];
+        std::vector<LODDraw> draws;
+        std::vector<PrefetchHint> hints;
+        draws.swap(chunk.draws);
+        hints.swap(chunk.hints);
+        draws.clear();
+        hints.clear();
+        LODStats stats;
+
+        size_t begin = std::min(m_entities.size(), chunkIndex * chunkSize);
+        size_t end = std::min(m_entities.size(), begin + chunkSize);
+        for (size_t i = begin; i < end; i++)
+        {
+            entt::entity entity = m_entities[i];
+            LODComponent& lod = view.get<LODComponent>(entity);
+            if (!lod.group || lod.group->levels.empty()) continue;
+            const glm::mat4& transform = view.get<TransformComponent>(entity).transform;
+
+            // Scale the bounds by the largest axis scale of the transform
+            float scale = std::max({ glm::length(glm::vec3(transform[0])),
+                                     glm::length(glm::vec3(transform[1])),
+                                     glm::length(glm::vec3(transform[2])) });
+            float size = projectedSize(camera, glm::vec3(transform[3]), lod.boundingRadius * scale);
+
+            uint32_t level = selectLevel(*lod.group, lod.current, size, m_settings.hysteresis);
+            if (level != lod.current) stats.switches++;
+            lod.current = level;
+
+            const std::vector<LODLevel>& levels = lod.group->levels;
+            draws.push_back(LODDraw{ levels[level].mesh, entity });
+            if (level > 0 && size >= levels[level - 1].minScreenSize * (1.0f - m_settings.prefetchMargin))
+            {
+                hints.push_back(PrefetchHint{ levels[level - 1].mesh, entity });
+            }
+
+            stats.entities++;
+            stats.triangles += levels[level].triangleCount;
+            stats.fullDetailTriangles += levels[0].triangleCount;
+        }
+
+        chunk.draws.swap(draws);
+        chunk.hints.swap(hints);
+        chunk.stats = stats;
+    };
+
+    m_jobs.run(threads, select);
+
+    m_draws.clear();
+    m_hints.clear();
+    m_stats = LODStats{};
+    for (const Chunk& chunk : m_chunks)
+    {
+        m_draws.insert(m_draws.end(), chunk.draws.begin(), chunk.draws.end());
+        m_hints.insert(m_hints.end(), chunk.hints.begin(), chunk.hints.end());
+        m_stats.entities += chunk.stats.entities;
+        m_stats.switches += chunk.stats.switches;
+        m_stats.triangles += chunk.stats.triangles;
+        m_stats.fullDetailTriangles += chunk.stats.fullDetailTriangles;
+    }
+    std::stable_sort(m_draws.begin(), m_draws.end(),
+        [](const LODDraw& a, const LODDraw& b) { return a.mesh < b.mesh; });
+
+    m_stats.selectMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
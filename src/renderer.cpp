@@ -1,85 +1,106 @@
+#include <cstring>
+#include <fstream>
+#include <sstream>
 #include <glfw/glfw3.h>
 #include <glfw3webgpu.h>
 #include "renderer.hpp"
 #include "utils.hpp"
 
 void setDefault(WGPULimits &limits) {
-    limits.maxTextureDimension1D = 0;
-    limits.maxTextureDimension2D = 0;
-    limits.maxTextureDimension3D = 0;
-    limits.maxBufferSize = 0;
-    // [...] Set everything to 0 to mean "no limit"
+    // Every limit is a uint32_t or uint64_t, all bits set is WGPU_LIMIT_U32_UNDEFINED /
+    // WGPU_LIMIT_U64_UNDEFINED, meaning "no requirement, use the default"
+    std::memset(&limits, 0xFF, sizeof(limits));
 }
 
-void setDefaults(WGPUAdapter adapter, WGPUDevice device)
+void setDefaults(const WebGPUProcs& gpu, WGPUAdapter adapter, WGPUDevice device)
 {
     WGPUSupportedLimits supportedLimits{};
     supportedLimits.nextInChain = nullptr;
 
-    wgpuAdapterGetLimits(adapter, &supportedLimits);
+    gpu.adapterGetLimits(adapter, &supportedLimits);
     std::cout << "adapter.maxVertexAttributes: " << supportedLimits.limits.maxVertexAttributes << std::endl;
 
-    wgpuDeviceGetLimits(device, &supportedLimits);
+    gpu.deviceGetLimits(device, &supportedLimits);
     std::cout << "device.maxVertexAttributes: " << supportedLimits.limits.maxVertexAttributes << std::endl;
 }
 
-Renderer::Renderer(GLFWwindow* window)
+Renderer::Renderer(const WebGPUProcs& procs)
+    : gpu(procs)
 {
+}
 
+void Renderer::initInstance()
+{
     #pragma region Init WebGPU
     WGPUInstanceDescriptor desc = {};
     desc.nextInChain = nullptr;
 
-    instance = std::make_unique<WGPUInstance>(wgpuCreateInstance(&desc));
+    instance = std::make_unique<WGPUInstance>(gpu.createInstance(&desc));
 
-    if(!instance)
+    // Stages may run on a job thread, so leave cleaning up GLFW to whoever runs them
+    if(!*instance)
     {
         std::cerr << "Could not init webgpu" << std::endl;
-        glfwTerminate();
         throw std::exception();
     }
 
     std::cout << "WGPU instance: " << instance << std::endl;
-    
+    #pragma endregion
+}
+
+void Renderer::initSurface(GLFWwindow* window)
+{
+    surface = std::make_unique<WGPUSurface>(gpu.createSurface(*instance, window ));
+}
+
+void Renderer::initAdapter()
+{
     #pragma region adapter
     std::cout << "Requesting adapter..." << std::endl;
 
-    surface = std::make_unique<WGPUSurface>(glfwGetWGPUSurface(*instance, window ));
     WGPURequestAdapterOptions adapterOpts = {};
     adapterOpts.nextInChain = nullptr;
     adapterOpts.compatibleSurface = *surface;
-    adapter = std::make_unique<WGPUAdapter>(requestAdapter(*instance, &adapterOpts));
+    adapter = std::make_unique<WGPUAdapter>(requestAdapter(*instance, &adapterOpts, gpu));
+    if (!*adapter)
+    {
+        std::cerr << "Could not get a WebGPU adapter" << std::endl;
+        throw std::exception();
+    }
 
     std::cout << "Got adapter: " << adapter << std::endl;
     #pragma endregion
 
     #pragma region features
     std::vector<WGPUFeatureName> features;
-    size_t featureCount = wgpuAdapterEnumerateFeatures(*adapter, nullptr);
+    size_t featureCount = gpu.adapterEnumerateFeatures(*adapter, nullptr);
     features.resize(featureCount);
-    wgpuAdapterEnumerateFeatures(*adapter, features.data());
+    gpu.adapterEnumerateFeatures(*adapter, features.data());
     std::cout << "Adapter features: " << std:: endl;
     for(auto f : features)
     {
         std::cout << " - " << f << std::endl;
     }
     #pragma endregion
+}
 
+void Renderer::initDevice()
+{
     #pragma region device
     std::cout << "Requesting device..." << std::endl;
 
-    WGPUSupportedLimits supportedLimits;
-    wgpuAdapterGetLimits(*adapter, &supportedLimits);
+    WGPUSupportedLimits supportedLimits{};
+    gpu.adapterGetLimits(*adapter, &supportedLimits);
 
-	std::cout << "Requesting device..." << std::endl;
-	// Don't forget to = Default
-	WGPURequiredLimits requiredLimits; // = Default?
+	WGPURequiredLimits requiredLimits{};
+	setDefault(requiredLimits.limits);
 	// We use at most 1 vertex attribute for now
 	requiredLimits.limits.maxVertexAttributes = 1;
 	// We should also tell that we use 1 vertex buffers
 	requiredLimits.limits.maxVertexBuffers = 1;
-	// Maximum size of a buffer is 6 vertices of 2 float each
-	requiredLimits.limits.maxBufferSize = 6 * 2 * sizeof(float);
+	// The transform buffer grows with the entity count, so allow whatever the adapter allows
+	requiredLimits.limits.maxBufferSize = supportedLimits.limits.maxBufferSize;
+	requiredLimits.limits.maxStorageBufferBindingSize = supportedLimits.limits.maxStorageBufferBindingSize;
 	// Maximum stride between 2 consecutive vertices in the vertex buffer
 	requiredLimits.limits.maxVertexBufferArrayStride = 2 * sizeof(float);
 	// This must be set even if we do not use storage buffers for now
@@ -96,55 +117,83 @@ Renderer::Renderer(GLFWwindow* window)
     deviceDesc.defaultQueue.nextInChain = nullptr;
     deviceDesc.defaultQueue.label = "The default queue";
 
-    device = std::make_unique<WGPUDevice>(requestDevice(*adapter, &deviceDesc));
+    device = std::make_unique<WGPUDevice>(requestDevice(*instance, *adapter, &deviceDesc, gpu));
+    if (!*device)
+    {
+        std::cerr << "Could not get a WebGPU device" << std::endl;
+        throw std::exception();
+    }
 
     std::cout << "Got device: " << device << std::endl;
-    setDefaults(*adapter, *device);
+    setDefaults(gpu, *adapter, *device);
 
     auto onDeviceError = [](WGPUErrorType type, char const* message, void* /* pUserData */) {
         std::cout << "Uncaptured device error: type " << type;
         if (message) std::cout << " (" << message << ")";
         std::cout << std::endl;
     };
-    wgpuDeviceSetUncapturedErrorCallback(*device, onDeviceError, nullptr /* pUserData */);
+    gpu.deviceSetUncapturedErrorCallback(*device, onDeviceError, nullptr /* pUserData */);
     #pragma endregion
 
     #pragma region command queue
-    queue = std::make_unique<WGPUQueue>(wgpuDeviceGetQueue(*device));
+    queue = std::make_unique<WGPUQueue>(gpu.deviceGetQueue(*device));
     auto onQueueWorkDone = [](WGPUQueueWorkDoneStatus status, void* /* pUserData */) {
     std::cout << "Queued work finished with status: " << status << std::endl;
     };
     uint64_t signalValue = 0;
-    wgpuQueueOnSubmittedWorkDone(*queue, signalValue , onQueueWorkDone, nullptr /* pUserData */);
+    gpu.queueOnSubmittedWorkDone(*queue, signalValue , onQueueWorkDone, nullptr /* pUserData */);
     #pragma endregion
+}
 
+void Renderer::initSwapChain()
+{
     #pragma region swap chain
     WGPUSwapChainDescriptor swapChainDesc = {};
     swapChainDesc.nextInChain = nullptr;
-    swapChainDesc.width = 640;
-    swapChainDesc.height = 480;
-    WGPUTextureFormat swapChainFormat = WGPUTextureFormat_BGRA8Unorm;//wgpuSurfaceGetPreferredFormat(surface, adapter);
+    swapChainDesc.width = width;
+    swapChainDesc.height = height;
     swapChainDesc.format = swapChainFormat;
     swapChainDesc.usage = WGPUTextureUsage_RenderAttachment;
-    swapChainDesc.presentMode = WGPUPresentMode_Fifo;
-    swapChain = std::make_unique<WGPUSwapChain>(wgpuDeviceCreateSwapChain(*device, *surface, &swapChainDesc));
+    // Mailbox/Immediate are not available everywhere. There is no way to ask
+    // up front, so an error scope catches the validation error and render()
+    // falls back to Fifo once it is reported
+    swapChainDesc.presentMode = presentMode;
+    std::lock_guard<std::mutex> lock(deviceMutex);
+    // Frames still in flight keep their own reference to the old swap chain,
+    // so there is no need to wait for the GPU before replacing it
+    if (swapChain && *swapChain) gpu.swapChainRelease(*swapChain);
+    swapChainOutdated = false;
+    swapChainRejected = false;
+    gpu.devicePushErrorScope(*device, WGPUErrorFilter_Validation);
+    swapChain = std::make_unique<WGPUSwapChain>(gpu.deviceCreateSwapChain(*device, *surface, &swapChainDesc));
+    auto onSwapChainError = [](WGPUErrorType type, char const* message, void* pUserData) {
+        if (type == WGPUErrorType_NoError) return;
+        std::cerr << "Could not create swap chain: " << (message ? message : "") << std::endl;
+        reinterpret_cast<Renderer*>(pUserData)->swapChainRejected = true;
+    };
+    gpu.devicePopErrorScope(*device, onSwapChainError, this);
+    if (!*swapChain) swapChainRejected = true;
     std::cout << "Swapchain: " << swapChain << std::endl;
     #pragma endregion
-
-    #pragma region Shader
-    	std::cout << "Creating shader module..." << std::endl;
-	const char* shaderSource = R"(
-@vertex
-fn vs_main(@location(0) in_vertex_position: vec2f) -> @builtin(position) vec4f {
-    return vec4f(in_vertex_position, 0.0, 1.0);
 }
 
-@fragment
-fn fs_main() -> @location(0) vec4f {
-    return vec4f(0.0, 1.0, 1.0, 1.0);
+std::string Renderer::loadShaderSource(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file.is_open())
+    {
+        std::cerr << "Could not open shader " << path << std::endl;
+        throw std::exception();
+    }
+    std::stringstream source;
+    source << file.rdbuf();
+    return source.str();
 }
-)";
 
+void Renderer::initPipeline(const std::string& shaderSource)
+{
+    #pragma region Shader
+    	std::cout << "Creating shader module..." << std::endl;
 	WGPUShaderModuleDescriptor shaderDesc = {};
 	shaderDesc.nextInChain = nullptr;
 #ifdef WEBGPU_BACKEND_WGPU
@@ -161,7 +210,7 @@ fn fs_main() -> @location(0) vec4f {
 	shaderDesc.nextInChain = &shaderCodeDesc.chain;
 
 	// Setup the actual payload of the shader code descriptor
-	shaderCodeDesc.code = shaderSource;
+	shaderCodeDesc.code = shaderSource.c_str();
 
     // Vertex fetch
     WGPUVertexAttribute vertexAttrib;
@@ -182,7 +231,8 @@ fn fs_main() -> @location(0) vec4f {
     vertexBufferLayout.stepMode = WGPUVertexStepMode_Vertex;
     // [...] Build vertex buffer layout
 
-	WGPUShaderModule shaderModule = wgpuDeviceCreateShaderModule(*device, &shaderDesc);
+	std::lock_guard<std::mutex> lock(deviceMutex);
+	WGPUShaderModule shaderModule = gpu.deviceCreateShaderModule(*device, &shaderDesc);
 	std::cout << "Shader module: " << shaderModule << std::endl;
 	std::cout << "Creating render pipeline..." << std::endl;
 	WGPURenderPipelineDescriptor pipelineDesc = {};
@@ -259,27 +309,13 @@ fn fs_main() -> @location(0) vec4f {
 	// Pipeline layout
 	pipelineDesc.layout = nullptr;
 
-	pipeline = std::make_unique<WGPURenderPipeline>(wgpuDeviceCreateRenderPipeline(*device, &pipelineDesc));
+	pipeline = std::make_unique<WGPURenderPipeline>(gpu.deviceCreateRenderPipeline(*device, &pipelineDesc));
 	std::cout << "Render pipeline: " << pipeline << std::endl;
+	// The pipeline keeps what it needs from the module
+	gpu.shaderModuleRelease(shaderModule);
     #pragma endregion
 
-    #pragma endregion
-
-}
-
-Renderer::~Renderer()
-{
-    wgpuSwapChainRelease(*swapChain);
-    wgpuDeviceRelease(*device);
-    wgpuAdapterRelease(*adapter);
-    wgpuSurfaceRelease(*surface);
-    wgpuInstanceRelease(*instance);
-    wgpuQueueReference(*queue);
-    // remove pipeline from device?    
-}
-
-void draw(WGPUQueue queue, WGPUDevice device, WGPURenderPassEncoder renderPass)
-{
+    #pragma region vertex buffer
     // Vertex buffer
     // There are 2 floats per vertex, one for x and one for y.
     // But in the end this is just a bunch of floats to the eyes of the GPU,
@@ -294,29 +330,91 @@ void draw(WGPUQueue queue, WGPUDevice device, WGPURenderPassEncoder renderPass)
         // x2, y2
         +0.0, +0.5
     };
-    int vertexCount = static_cast<int>(vertexData.size() / 2);
+    vertexCount = static_cast<uint32_t>(vertexData.size() / 2);
     // Create vertex buffer
     WGPUBufferDescriptor bufferDesc{};
     bufferDesc.nextInChain = nullptr;
     bufferDesc.size = vertexData.size() * sizeof(float);
     bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Vertex;
     bufferDesc.mappedAtCreation = false;
-    WGPUBuffer vertexBuffer = wgpuDeviceCreateBuffer(device, &bufferDesc);
+    vertexBuffer = gpu.deviceCreateBuffer(*device, &bufferDesc);
 
     // Upload geometry data to the buffer
-    wgpuQueueWriteBuffer(queue, vertexBuffer, 0, vertexData.data(), bufferDesc.size);
+    gpu.queueWriteBuffer(*queue, vertexBuffer, 0, vertexData.data(), bufferDesc.size);
+    #pragma endregion
+}
 
+Renderer::~Renderer()
+{
+    if (transformBuffer) gpu.bufferRelease(transformBuffer);
+    if (vertexBuffer) gpu.bufferRelease(vertexBuffer);
+    // A failed startup may leave some stages not run, or a handle null
+    if (pipeline && *pipeline) gpu.renderPipelineRelease(*pipeline);
+    if (swapChain && *swapChain) gpu.swapChainRelease(*swapChain);
+    if (queue && *queue) gpu.queueRelease(*queue);
+    if (device && *device) gpu.deviceRelease(*device);
+    if (adapter && *adapter) gpu.adapterRelease(*adapter);
+    if (surface && *surface) gpu.surfaceRelease(*surface);
+    if (instance && *instance) gpu.instanceRelease(*instance);
+}
+
+void draw(WGPURenderPassEncoder renderPass, WGPUBuffer vertexBuffer, uint32_t vertexCount)
+{
     // Set vertex buffer while encoding the render pass
-    wgpuRenderPassEncoderSetVertexBuffer(renderPass, 0, vertexBuffer, 0, vertexData.size() * sizeof(float));
+    wgpuRenderPassEncoderSetVertexBuffer(renderPass, 0, vertexBuffer, 0, vertexCount * 2 * sizeof(float));
 
     // We use the `vertexCount` variable instead of hard-coding the vertex count
     wgpuRenderPassEncoderDraw(renderPass, vertexCount, 1, 0, 0);
 }
 
+void Renderer::resize(uint32_t newWidth, uint32_t newHeight)
+{
+    if (newWidth == width && newHeight == height) return;
+    width = newWidth;
+    height = newHeight;
+    swapChainOutdated = true;
+}
+
+void Renderer::setPresentMode(WGPUPresentMode mode)
+{
+    if (mode == presentMode) return;
+    presentMode = mode;
+    swapChainOutdated = true;
+}
+
+bool Renderer::fallBackToFifo()
+{
+    if (presentMode == WGPUPresentMode_Fifo) return false;
+    std::cout << "Present mode " << presentMode << " is not supported, falling back to Fifo" << std::endl;
+    presentMode = WGPUPresentMode_Fifo;
+    swapChainOutdated = true;
+    return true;
+}
+
+void Renderer::onSubmittedWorkDone(WGPUQueueWorkDoneCallback callback, void* userData)
+{
+    uint64_t signalValue = 0;
+    wgpuQueueOnSubmittedWorkDone(*queue, signalValue, callback, userData);
+}
+
 void Renderer::render(WGPUColor clearColor)
 {
+    // Minimized, there is nothing to draw into
+    if (width == 0 || height == 0) return;
+    if (swapChainRejected) fallBackToFifo();
+    if (swapChainOutdated) initSwapChain();
+    // Skip the frame rather than draw into a swap chain that was rejected
+    if (swapChainRejected && fallBackToFifo()) return;
+    // Fifo is always supported, if even that fails there is nothing left to fall back to
+    if (!*swapChain || swapChainRejected)
+    {
+        std::cerr << "Could not create a Fifo swap chain" << std::endl;
+        throw std::exception();
+    }
+
     WGPUTextureView nextTexture = wgpuSwapChainGetCurrentTextureView(*swapChain);
     if (!nextTexture) {
+        if (fallBackToFifo()) return;
         std::cerr << "Cannot acquire next swap chain texture" << std::endl;
         throw std::exception();
     }
@@ -348,17 +446,46 @@ void Renderer::render(WGPUColor clearColor)
     wgpuRenderPassEncoderSetPipeline(renderPass, *pipeline);
     // Draw 1 instance of a 3-vertices shape
     //wgpuRenderPassEncoderDraw(renderPass, 3, 1, 0, 0);
-    draw(*queue, *device, renderPass);
+    draw(renderPass, vertexBuffer, vertexCount);
 
     wgpuRenderPassEncoderEnd(renderPass);
-    
+    wgpuRenderPassEncoderRelease(renderPass);
+
     wgpuTextureViewRelease(nextTexture);
 
     WGPUCommandBufferDescriptor cmdBufferDesc = {};
     cmdBufferDesc.nextInChain = nullptr;
     cmdBufferDesc.label = "Command buffer";
     WGPUCommandBuffer command = wgpuCommandEncoderFinish(encoder, &cmdBufferDesc);
+    wgpuCommandEncoderRelease(encoder);
     wgpuQueueSubmit(*queue, 1, &command);
+    wgpuCommandBufferRelease(command);
 
     wgpuSwapChainPresent(*swapChain);
+}
+
+void Renderer::uploadTransforms(const engine::game::TransformSync& sync)
+{
+    if (sync.capacity() != transformCapacity)
+    {
+        // Capacity only changes together with a full upload, so the old contents can go
+        if (transformBuffer) wgpuBufferRelease(transformBuffer);
+        WGPUBufferDescriptor bufferDesc{};
+        bufferDesc.nextInChain = nullptr;
+        bufferDesc.label = "Transforms";
+        bufferDesc.size = static_cast<uint64_t>(sync.capacity()) * sizeof(glm::mat4);
+        bufferDesc.usage = WGPUBufferUsage_CopyDst | WGPUBufferUsage_Storage;
+        bufferDesc.mappedAtCreation = false;
+        transformBuffer = wgpuDeviceCreateBuffer(*device, &bufferDesc);
+        transformCapacity = sync.capacity();
+    }
+
+    const glm::mat4* slots = sync.data();
+    for (const engine::game::UploadRange& range : sync.ranges())
+    {
+        wgpuQueueWriteBuffer(*queue, transformBuffer,
+            static_cast<uint64_t>(range.firstSlot) * sizeof(glm::mat4),
+            slots + range.firstSlot,
+            static_cast<size_t>(range.slotCount) * sizeof(glm::mat4));
+    }
 }
\ No newline at end of file
@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cassert>
+#include <condition_variable>
+#include <exception>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+#include "startup.hpp"
+
+namespace engine::startup
+{
+
+StartupGraph::TaskId StartupGraph::add(const std::string& name, std::function<void()> fn,
+                                       std::vector<TaskId> dependencies, Affinity affinity)
+{
+    TaskId id = m_tasks.size();
+    for (TaskId dependency : dependencies)
+    {
+        // Tasks can only depend on tasks added before them, so there are no cycles
+        assert(dependency < id);
+        m_tasks[dependency].dependents.push_back(id);
+    }
+    Task task;
+    task.name = name;
+    task.fn = std::move(fn);
+    task.dependencies = std::move(dependencies);
+    task.affinity = affinity;
+    m_tasks.push_back(std::move(task));
+    return id;
+}
+
+double StartupGraph::elapsed() const
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_startTime).count();
+}
+
+void StartupGraph::run(unsigned jobThreads)
+{
+    m_startTime = std::chrono::steady_clock::now();
+    jobThreads = std::max(1u, jobThreads);
+
+    // Length of the longest chain of dependents, tasks are added in dependency order
+    std::vector<size_t> height(m_tasks.size(), 1);
+    for (TaskId id = m_tasks.size(); id-- > 0;)
+    {
+        for (TaskId dependent : m_tasks[id].dependents)
+        {
+            height[id] = std::max(height[id], height[dependent] + 1);
+        }
+    }
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<TaskId> readyMain;
+    std::vector<TaskId> readyAny;
+    std::vector<size_t> remaining(m_tasks.size());
+    size_t done = 0;
+    std::exception_ptr error;
+
+    for (TaskId id = 0; id < m_tasks.size(); id++)
+    {
+        remaining[id] = m_tasks[id].dependencies.size();
+        if (remaining[id] == 0)
+            (m_tasks[id].affinity == Affinity::Main ? readyMain : readyAny).push_back(id);
+    }
+
+    auto finished = [&]() { return error || done == m_tasks.size(); };
+
+    // Takes the ready task with the longest chain behind it
+    auto take = [&](std::vector<TaskId>& ready) {
+        auto best = std::max_element(ready.begin(), ready.end(),
+            [&](TaskId a, TaskId b) { return height[a] < height[b]; });
+        TaskId id = *best;
+        ready.erase(best);
+        return id;
+    };
+
+    // The main thread only helps with an Any task if that does not hold up a
+    // Main task with a longer chain behind it, one that is not ready yet but
+    // will be soon (surface waiting for instance)
+    std::vector<bool> started(m_tasks.size(), false);
+    auto mainCanHelp = [&]() {
+        if (readyAny.empty()) return false;
+        size_t best = 0;
+        for (TaskId id : readyAny) best = std::max(best, height[id]);
+        for (TaskId id = 0; id < m_tasks.size(); id++)
+        {
+            if (m_tasks[id].affinity == Affinity::Main && !started[id] && height[id] > best) return false;
+        }
+        return true;
+    };
+
+    // Called with the lock held, runs the task without it
+    auto execute = [&](TaskId id, std::unique_lock<std::mutex>& lock) {
+        Task& task = m_tasks[id];
+        started[id] = true;
+        lock.unlock();
+        task.start = elapsed();
+        std::exception_ptr taskError;
+        try
+        {
+            task.fn();
+        }
+        catch (...)
+        {
+            taskError = std::current_exception();
+        }
+        task.end = elapsed();
+        lock.lock();
+
+        done++;
+        if (taskError)
+        {
+            if (!error) error = taskError;
+        }
+        else
+        {
+            for (TaskId dependent : task.dependents)
+            {
+                if (--remaining[dependent] == 0)
+                    (m_tasks[dependent].affinity == Affinity::Main ? readyMain : readyAny).push_back(dependent);
+            }
+        }
+        wake.notify_all();
+    };
+
+    std::vector<std::thread> workers;
+    for (unsigned i = 0; i < jobThreads; i++)
+    {
+        workers.emplace_back([&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true)
+            {
+                wake.wait(lock, [&]() { return finished() || !readyAny.empty(); });
+                if (finished()) break;
+                execute(take(readyAny), lock);
+            }
+        });
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true)
+        {
+            wake.wait(lock, [&]() { return finished() || !readyMain.empty() || mainCanHelp(); });
+            if (finished()) break;
+            execute(take(readyMain.empty() ? readyAny : readyMain), lock);
+        }
+    }
+
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+    m_totalTime = elapsed();
+
+    if (error) std::rethrow_exception(error);
+}
+
+std::vector<StartupGraph::TaskId> StartupGraph::criticalPath() const
+{
+    std::vector<TaskId> path;
+    if (m_tasks.empty()) return path;
+
+    // Longest chain by summed duration, independent of how the run happened
+    // to be scheduled. Tasks are added in dependency order.
+    const TaskId none = m_tasks.size();
+    std::vector<double> chainTime(m_tasks.size());
+    std::vector<TaskId> previous(m_tasks.size(), none);
+    TaskId last = 0;
+    for (TaskId id = 0; id < m_tasks.size(); id++)
+    {
+        double before = 0;
+        for (TaskId dependency : m_tasks[id].dependencies)
+        {
+            if (chainTime[dependency] > before)
+            {
+                before = chainTime[dependency];
+                previous[id] = dependency;
+            }
+        }
+        chainTime[id] = before + (m_tasks[id].end - m_tasks[id].start);
+        if (chainTime[id] > chainTime[last]) last = id;
+    }
+
+    for (TaskId id = last; id != none; id = previous[id])
+    {
+        path.push_back(id);
+    }
+    return std::vector<TaskId>(path.rbegin(), path.rend());
+}
+
+double StartupGraph::criticalPathTime() const
+{
+    double time = 0;
+    for (TaskId id : criticalPath())
+    {
+        time += m_tasks[id].end - m_tasks[id].start;
+    }
+    return time;
+}
+
+void StartupGraph::report(std::ostream& out) const
+{
+    out << "Startup stages (ms):" << std::endl;
+    out << std::fixed << std::setprecision(2);
+    for (const Task& task : m_tasks)
+    {
+        out << " - " << std::left << std::setw(14) << task.name << std::right
+            << " start " << std::setw(8) << task.start * 1000.0
+            << " end " << std::setw(8) << task.end * 1000.0
+            << " took " << std::setw(8) << (task.end - task.start) * 1000.0 << std::endl;
+    }
+
+    double serial = 0;
+    for (const Task& task : m_tasks)
+    {
+        serial += task.end - task.start;
+    }
+    out << "Critical path:";
+    for (TaskId id : criticalPath())
+    {
+        out << " " << m_tasks[id].name;
+    }
+    out << " (" << criticalPathTime() * 1000.0 << " ms)" << std::endl;
+    out << "Startup took " << m_totalTime * 1000.0 << " ms (" << serial * 1000.0 << " ms if serial)" << std::endl;
+    out.unsetf(std::ios_base::floatfield);
+}
+
+void buildStartupGraph(StartupGraph& graph, const StartupStages& stages)
+{
+    // GLFW and the surface have to stay on the main thread
+    auto window = graph.add("window", stages.window, {}, Affinity::Main);
+    auto instance = graph.add("instance", stages.instance);
+    auto surface = graph.add("surface", stages.surface, { window, instance }, Affinity::Main);
+    auto adapter = graph.add("adapter", stages.adapter, { surface });
+    auto device = graph.add("device", stages.device, { adapter });
+    graph.add("swapChain", stages.swapChain, { device, surface });
+    auto shaderSource = graph.add("shaderSource", stages.shaderSource);
+    graph.add("pipeline", stages.pipeline, { device, shaderSource });
+    graph.add("scene", stages.scene);
+}
+
+StartupStages buildRendererStages(Renderer& renderer, GLFWwindow*& window, std::string& shaderSource)
+{
+    StartupStages stages;
+    stages.instance = [&]() { renderer.initInstance(); };
+    stages.surface = [&]() { renderer.initSurface(window); };
+    stages.adapter = [&]() { renderer.initAdapter(); };
+    stages.device = [&]() { renderer.initDevice(); };
+    stages.swapChain = [&]() { renderer.initSwapChain(); };
+    stages.shaderSource = [&]() { shaderSource = Renderer::loadShaderSource(RESOURCE_DIR "/shader.wgsl"); };
+    stages.pipeline = [&]() { renderer.initPipeline(shaderSource); };
+    return stages;
+}
+
+}
\ No newline at end of file
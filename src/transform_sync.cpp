@@ -0,0 +1,150 @@
+#include <algorithm>
+#include "transform_sync.hpp"
+#include "game.hpp"
+
+using namespace engine::game;
+
+TransformSync::TransformSync(entt::registry& registry)
+    : m_registry(registry)
+{
+    m_registry.on_construct<TransformComponent>().connect<&TransformSync::onConstruct>(*this);
+    m_registry.on_update<TransformComponent>().connect<&TransformSync::onUpdate>(*this);
+    m_registry.on_destroy<TransformComponent>().connect<&TransformSync::onDestroy>(*this);
+
+    // Pick up whatever was already in the registry before we were created
+    for (auto entity : m_registry.view<TransformComponent>())
+    {
+        onConstruct(m_registry, entity);
+    }
+}
+
+TransformSync::~TransformSync()
+{
+    m_registry.on_construct<TransformComponent>().disconnect<&TransformSync::onConstruct>(*this);
+    m_registry.on_update<TransformComponent>().disconnect<&TransformSync::onUpdate>(*this);
+    m_registry.on_destroy<TransformComponent>().disconnect<&TransformSync::onDestroy>(*this);
+}
+
+uint32_t TransformSync::slotOf(entt::entity entity) const
+{
+    auto index = static_cast<size_t>(entt::to_entity(entity));
+    if (index >= m_entityToSlot.size()) return InvalidSlot;
+    return m_entityToSlot[index];
+}
+
+void TransformSync::markDirty(uint32_t slot)
+{
+    if (m_dirty[slot]) return;
+    m_dirty[slot] = 1;
+    m_dirtyList.push_back(slot);
+}
+
+void TransformSync::onConstruct(entt::registry&, entt::entity entity)
+{
+    auto index = static_cast<size_t>(entt::to_entity(entity));
+    if (index >= m_entityToSlot.size())
+    {
+        m_entityToSlot.resize(index + 1, InvalidSlot);
+    }
+
+    uint32_t slot = static_cast<uint32_t>(m_slots.size());
+    m_entityToSlot[index] = slot;
+    m_slotToEntity.push_back(entity);
+    m_slots.emplace_back(1.0f);
+    m_dirty.push_back(0);
+    markDirty(slot);
+
+    if (m_slots.size() > m_capacity)
+    {
+        m_capacity = std::max<uint32_t>(64, m_capacity * 2);
+        m_resized = true;
+    }
+}
+
+void TransformSync::onUpdate(entt::registry&, entt::entity entity)
+{
+    markDirty(slotOf(entity));
+}
+
+void TransformSync::onDestroy(entt::registry&, entt::entity entity)
+{
+    auto index = static_cast<size_t>(entt::to_entity(entity));
+    uint32_t slot = m_entityToSlot[index];
+    uint32_t last = static_cast<uint32_t>(m_slots.size() - 1);
+    m_entityToSlot[index] = InvalidSlot;
+
+    if (slot != last)
+    {
+        // Move the last entity into the hole to keep the buffer compact
+        entt::entity moved = m_slotToEntity[last];
+        m_slots[slot] = m_slots[last];
+        m_slotToEntity[slot] = moved;
+        m_entityToSlot[static_cast<size_t>(entt::to_entity(moved))] = slot;
+        m_dirty[slot] = 0;
+        markDirty(slot);
+        m_pendingMoves.push_back(SlotMove{ moved, last, slot });
+    }
+
+    // Stale entries for the removed slot are filtered out in sync()
+    m_slots.pop_back();
+    m_slotToEntity.pop_back();
+    m_dirty.pop_back();
+}
+
+const SyncStats& TransformSync::sync(uint32_t maxGap)
+{
+    m_ranges.clear();
+    m_moved.clear();
+    m_moved.swap(m_pendingMoves);
+    m_stats = SyncStats{};
+    uint32_t count = slotCount();
+
+    // Refresh the mirror from the registry and drop stale or duplicate slots
+    size_t kept = 0;
+    for (uint32_t slot : m_dirtyList)
+    {
+        if (slot >= count || !m_dirty[slot]) continue;
+        m_dirty[slot] = 0;
+        m_slots[slot] = m_registry.get<TransformComponent>(m_slotToEntity[slot]).transform;
+        m_dirtyList[kept++] = slot;
+    }
+    m_dirtyList.resize(kept);
+    m_stats.dirtySlots = kept;
+
+    if (m_resized)
+    {
+        // The GPU buffer is recreated, so everything goes up in one go
+        m_resized = false;
+        m_stats.fullUpload = true;
+        if (count > 0) m_ranges.push_back(UploadRange{ 0, count });
+    }
+    else if (!m_dirtyList.empty())
+    {
+        std::sort(m_dirtyList.begin(), m_dirtyList.end());
+
+        UploadRange range{ m_dirtyList[0], 1 };
+        for (size_t i = 1; i < m_dirtyList.size(); i++)
+        {
+            uint32_t slot = m_dirtyList[i];
+            uint32_t end = range.firstSlot + range.slotCount;
+            if (slot - end <= maxGap)
+            {
+                range.slotCount = slot - range.firstSlot + 1;
+            }
+            else
+            {
+                m_ranges.push_back(range);
+                range = UploadRange{ slot, 1 };
+            }
+        }
+        m_ranges.push_back(range);
+    }
+    m_dirtyList.clear();
+
+    m_stats.ranges = m_ranges.size();
+    for (const UploadRange& range : m_ranges)
+    {
+        m_stats.bytesUploaded += range.slotCount * sizeof(glm::mat4);
+    }
+    return m_stats;
+}
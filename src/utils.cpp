@@ -1,19 +1,15 @@
 #include <webgpu/webgpu.hpp>
+#include <future>
+#include <thread>
+#include "utils.hpp"
 
-/**
- * Utility function to get a WebGPU adapter, so that
- *     WGPUAdapter adapter = requestAdapter(options);
- * is roughly equivalent to
- *     const adapter = await navigator.gpu.requestAdapter(options);
- */
-WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions const * options) {
-    // A simple structure holding the local information shared with the
-    // onAdapterRequestEnded callback.
-    struct UserData {
-        WGPUAdapter adapter = nullptr;
-        bool requestEnded = false;
-    };
-    UserData userData;
+std::future<WGPUAdapter> requestAdapterAsync(WGPUInstance instance, WGPURequestAdapterOptions const * options,
+                                             const WebGPUProcs& procs) {
+    // The promise is shared with the onAdapterRequestEnded callback, which
+    // may fire after this function returned, so it lives on the heap and the
+    // callback deletes it once the value is set.
+    auto promise = new std::promise<WGPUAdapter>();
+    std::future<WGPUAdapter> future = promise->get_future();
 
     // Callback called by wgpuInstanceRequestAdapter when the request returns
     // This is a C++ lambda function, but could be any function defined in the
@@ -24,64 +20,81 @@ WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions cons
     // provided as the last argument of wgpuInstanceRequestAdapter and received
     // by the callback as its last argument.
     auto onAdapterRequestEnded = [](WGPURequestAdapterStatus status, WGPUAdapter adapter, char const * message, void * pUserData) {
-        UserData& userData = *reinterpret_cast<UserData*>(pUserData);
-        if (status == WGPURequestAdapterStatus_Success) {
-            userData.adapter = adapter;
-        } else {
+        auto promise = reinterpret_cast<std::promise<WGPUAdapter>*>(pUserData);
+        if (status != WGPURequestAdapterStatus_Success) {
             std::cout << "Could not get WebGPU adapter: " << message << std::endl;
+            adapter = nullptr;
         }
-        userData.requestEnded = true;
+        promise->set_value(adapter);
+        delete promise;
     };
 
     // Call to the WebGPU request adapter procedure
-    wgpuInstanceRequestAdapter(
+    procs.instanceRequestAdapter(
         instance /* equivalent of navigator.gpu */,
         options,
         onAdapterRequestEnded,
-        (void*)&userData
+        (void*)promise
     );
 
-    // In theory we should wait until onAdapterReady has been called, which
-    // could take some time (what the 'await' keyword does in the JavaScript
-    // code). In practice, we know that when the wgpuInstanceRequestAdapter()
-    // function returns its callback has been called.
-    assert(userData.requestEnded);
-
-    return userData.adapter;
+    return future;
 }
 
 /**
- * Utility function to get a WebGPU device, so that
- *     WGPUAdapter device = requestDevice(adapter, options);
+ * Utility function to get a WebGPU adapter, so that
+ *     WGPUAdapter adapter = requestAdapter(options);
  * is roughly equivalent to
- *     const device = await adapter.requestDevice(descriptor);
- * It is very similar to requestAdapter
+ *     const adapter = await navigator.gpu.requestAdapter(options);
  */
-WGPUDevice requestDevice(WGPUAdapter adapter, WGPUDeviceDescriptor const * descriptor) {
-    struct UserData {
-        WGPUDevice device = nullptr;
-        bool requestEnded = false;
-    };
-    UserData userData;
+WGPUAdapter requestAdapter(WGPUInstance instance, WGPURequestAdapterOptions const * options,
+                           const WebGPUProcs& procs) {
+    std::future<WGPUAdapter> adapter = requestAdapterAsync(instance, options, procs);
+    return awaitCallback(instance, adapter, procs);
+}
+
+std::future<WGPUDevice> requestDeviceAsync(WGPUAdapter adapter, WGPUDeviceDescriptor const * descriptor,
+                                           const WebGPUProcs& procs) {
+    auto promise = new std::promise<WGPUDevice>();
+    std::future<WGPUDevice> future = promise->get_future();
 
     auto onDeviceRequestEnded = [](WGPURequestDeviceStatus status, WGPUDevice device, char const * message, void * pUserData) {
-        UserData& userData = *reinterpret_cast<UserData*>(pUserData);
-        if (status == WGPURequestDeviceStatus_Success) {
-            userData.device = device;
-        } else {
+        auto promise = reinterpret_cast<std::promise<WGPUDevice>*>(pUserData);
+        if (status != WGPURequestDeviceStatus_Success) {
             std::cout << "Could not get WebGPU device: " << message << std::endl;
+            device = nullptr;
         }
-        userData.requestEnded = true;
+        promise->set_value(device);
+        delete promise;
     };
 
-    wgpuAdapterRequestDevice(
+    procs.adapterRequestDevice(
         adapter,
         descriptor,
         onDeviceRequestEnded,
-        (void*)&userData
+        (void*)promise
     );
 
-    assert(userData.requestEnded);
+    return future;
+}
+
+/**
+ * Utility function to get a WebGPU device, so that
+ *     WGPUAdapter device = requestDevice(adapter, options);
+ * is roughly equivalent to
+ *     const device = await adapter.requestDevice(descriptor);
+ * It is very similar to requestAdapter
+ */
+WGPUDevice requestDevice(WGPUInstance instance, WGPUAdapter adapter, WGPUDeviceDescriptor const * descriptor,
+                         const WebGPUProcs& procs) {
+    std::future<WGPUDevice> device = requestDeviceAsync(adapter, descriptor, procs);
+    return awaitCallback(instance, device, procs);
+}
 
-    return userData.device;
+void processEvents(WGPUInstance instance) {
+#ifdef WEBGPU_BACKEND_WGPU
+    // wgpu-native fires these callbacks before the request function returns
+    (void)instance;
+#else
+    wgpuInstanceProcessEvents(instance);
+#endif
 }
\ No newline at end of file
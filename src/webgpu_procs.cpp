@@ -0,0 +1,150 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "webgpu_procs.hpp"
+#include "utils.hpp"
+
+const WebGPUProcs& webgpuProcs()
+{
+    static const WebGPUProcs procs = {
+        wgpuCreateInstance,
+        glfwGetWGPUSurface,
+        wgpuInstanceRequestAdapter,
+        processEvents,
+        wgpuAdapterEnumerateFeatures,
+        wgpuAdapterGetLimits,
+        wgpuAdapterRequestDevice,
+        wgpuDeviceGetLimits,
+        wgpuDeviceSetUncapturedErrorCallback,
+        wgpuDevicePushErrorScope,
+        wgpuDevicePopErrorScope,
+        wgpuDeviceGetQueue,
+        wgpuQueueOnSubmittedWorkDone,
+        wgpuDeviceCreateSwapChain,
+        wgpuDeviceCreateShaderModule,
+        wgpuDeviceCreateRenderPipeline,
+        wgpuDeviceCreateBuffer,
+        wgpuQueueWriteBuffer,
+
+        wgpuShaderModuleRelease,
+        wgpuBufferRelease,
+        wgpuRenderPipelineRelease,
+        wgpuSwapChainRelease,
+        wgpuQueueRelease,
+        wgpuDeviceRelease,
+        wgpuAdapterRelease,
+        wgpuSurfaceRelease,
+        wgpuInstanceRelease,
+    };
+    return procs;
+}
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    MockDeviceTimings mockTimings;
+
+    // Callbacks waiting for their delay to pass, delivered by mockProcessEvents
+    struct PendingCallback
+    {
+        Clock::time_point due;
+        std::function<void()> callback;
+    };
+    std::mutex pendingMutex;
+    std::vector<PendingCallback> pending;
+
+    void schedule(double delay, std::function<void()> callback)
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        auto due = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(delay));
+        pending.push_back(PendingCallback{ due, std::move(callback) });
+    }
+
+    void mockProcessEvents(WGPUInstance)
+    {
+        std::vector<std::function<void()>> ready;
+        {
+            std::lock_guard<std::mutex> lock(pendingMutex);
+            auto now = Clock::now();
+            auto due = std::stable_partition(pending.begin(), pending.end(),
+                [&](const PendingCallback& p) { return p.due > now; });
+            for (auto it = due; it != pending.end(); ++it)
+            {
+                ready.push_back(std::move(it->callback));
+            }
+            pending.erase(due, pending.end());
+        }
+        // Outside the lock, a callback may well request something else
+        for (auto& callback : ready)
+        {
+            callback();
+        }
+    }
+
+    void busy(double seconds)
+    {
+        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+    }
+
+    // Distinct non-null handles, never dereferenced
+    template<typename Handle>
+    Handle dummyHandle()
+    {
+        static std::atomic<uintptr_t> next{ 0x1000 };
+        return reinterpret_cast<Handle>(next.fetch_add(0x10));
+    }
+}
+
+const WebGPUProcs& mockWebGPUProcs(MockDeviceTimings timings)
+{
+    mockTimings = timings;
+
+    // Generic lambdas convert to whatever function pointer type the table
+    // needs, so the mocks don't depend on the exact WebGPU header revision
+    static const WebGPUProcs procs = {
+        [](auto...) { busy(mockTimings.instance); return dummyHandle<WGPUInstance>(); },
+        [](auto...) { return dummyHandle<WGPUSurface>(); },
+        [](auto, auto, auto callback, auto userData) {
+            schedule(mockTimings.adapter, [=]() {
+                callback(WGPURequestAdapterStatus_Success, dummyHandle<WGPUAdapter>(), nullptr, userData);
+            });
+        },
+        mockProcessEvents,
+        [](auto, auto) { return size_t(0); },
+        [](auto, auto limits) { *limits = {}; return decltype(wgpuAdapterGetLimits(nullptr, nullptr))(true); },
+        [](auto, auto, auto callback, auto userData) {
+            schedule(mockTimings.device, [=]() {
+                callback(WGPURequestDeviceStatus_Success, dummyHandle<WGPUDevice>(), nullptr, userData);
+            });
+        },
+        [](auto, auto limits) { *limits = {}; return decltype(wgpuDeviceGetLimits(nullptr, nullptr))(true); },
+        [](auto...) {},
+        [](auto...) {},
+        // The mock never reports an error, so the callback is never called
+        [](auto...) { return decltype(wgpuDevicePopErrorScope(nullptr, nullptr, nullptr))(true); },
+        [](auto...) { return dummyHandle<WGPUQueue>(); },
+        [](auto...) {},
+        [](auto...) { busy(mockTimings.swapChain); return dummyHandle<WGPUSwapChain>(); },
+        [](auto...) { busy(mockTimings.shaderModule); return dummyHandle<WGPUShaderModule>(); },
+        [](auto...) { busy(mockTimings.pipeline); return dummyHandle<WGPURenderPipeline>(); },
+        [](auto...) { return dummyHandle<WGPUBuffer>(); },
+        [](auto...) {},
+
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+        [](auto...) {},
+    };
+    return procs;
+}